@@ -10,7 +10,7 @@
 #include <string>
 #include <unordered_set>
 #include <vector>
-#include <sstream>
+#include "scanner.hh"
 
 namespace ds_compiler {
 
@@ -22,12 +22,15 @@ public:
     //"main" methods, compile from is to os
     void compile_intermediate(const std::string input_line);  //compiles a single line of input
     void compile_full (const std::vector<std::string> source, const std::string class_name);         //compiles a full C++ program
+    void compile_shared (const std::vector<std::string> source, const std::string class_name);       //compiles a program exporting the C interface in program_abi.hh
     
     static const size_t NUM_REGISTERS;          //number of registers available to the compiled code
                                                 //public so test generation code can reference it
     
 private:
 
+    static const size_t NUM_VARIABLES;          //one per letter; get_name() only returns A-Z
+    static const size_t STACK_SIZE;             //capacity of the compiled code's inline stack
     static const char ERR_CHAR;
     static const std::unordered_set<char> ADD_OPS;
     static const std::unordered_set<char> MULT_OPS;
@@ -46,6 +49,7 @@ private:
     void define_getters() const;
     void define_is_stack_empty() const;
     void define_dump() const;
+    void define_c_interface(const std::string class_name) const;
     
     //parsing methods
     void start_symbol();
@@ -60,6 +64,7 @@ private:
     void expected(const std::string expect) const;
     void expected(const char c) const;
     void match(const char c);
+    void skip_white();
     char get_name ();
     char get_num ();
     void emit (std::string s) const;
@@ -67,7 +72,7 @@ private:
     
     static bool is_in(const char elem, const std::unordered_set<char> us);
     
-    std::stringstream m_input_stream;
+    Scanner m_scanner;
     std::ostream& m_output_stream;
     
 };
@@ -0,0 +1,48 @@
+/*
+    C interface exported by programs built with Compiler::compile_shared().
+    Shared between the compiler (which emits it) and ProgramModule (which loads it).
+
+*/
+
+#ifndef PROGRAM_ABI_HH
+#define PROGRAM_ABI_HH
+
+#include <cstddef>
+
+namespace ds_compiler {
+
+namespace program_abi {
+
+//bump whenever a signature below changes
+const int VERSION = 2;
+
+//getters return 1 on success, 0 if the register/variable doesn't exist
+typedef int   (*abi_version_fn)  ();
+typedef void* (*create_fn)       ();
+typedef void  (*run_fn)          (void* program);
+typedef int   (*get_register_fn) (void* program, int index, int* value);
+typedef int   (*get_variable_fn) (void* program, char var_name, int* value);
+typedef void  (*destroy_fn)      (void* program);
+
+//placement construction into caller-owned storage of state_size() bytes, aligned to state_align()
+typedef std::size_t (*state_size_fn)  ();
+typedef std::size_t (*state_align_fn) ();
+typedef void        (*construct_fn)   (void* storage);
+typedef void        (*destruct_fn)    (void* program);
+
+const char* const ABI_VERSION_SYMBOL  = "ds_abi_version";
+const char* const CREATE_SYMBOL       = "ds_create";
+const char* const RUN_SYMBOL          = "ds_run";
+const char* const GET_REGISTER_SYMBOL = "ds_get_register";
+const char* const GET_VARIABLE_SYMBOL = "ds_get_variable";
+const char* const DESTROY_SYMBOL      = "ds_destroy";
+const char* const STATE_SIZE_SYMBOL   = "ds_state_size";
+const char* const STATE_ALIGN_SYMBOL  = "ds_state_align";
+const char* const CONSTRUCT_SYMBOL    = "ds_construct";
+const char* const DESTRUCT_SYMBOL     = "ds_destruct";
+
+} //end namespace program_abi
+
+} //end namespace
+
+#endif
@@ -0,0 +1,149 @@
+/*
+    Running many instances of compiled programs across all cores.
+
+    InstanceSlab placement-constructs a batch of instances of one program
+    into a single cache-line-aligned block, one instance per stride, so
+    neighbouring instances never share a cache line. Blocks can come from a
+    SlabPool, which keeps a bounded number of released blocks for the next
+    slab instead of freeing them.
+    ProgramExecutor owns a pool of worker threads, each with its own deque
+    of work; an idle worker steals from the front of another worker's deque.
+
+*/
+
+#ifndef PROGRAM_EXECUTOR_HH
+#define PROGRAM_EXECUTOR_HH
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "program_module.hh"
+
+namespace ds_compiler {
+
+//thread-safe; must outlive every InstanceSlab built from it
+class SlabPool {
+
+public:
+    struct Block {
+        void* storage;
+        size_t bytes;
+    };
+
+    explicit SlabPool(const size_t max_idle_blocks = DEFAULT_MAX_IDLE_BLOCKS);
+    ~SlabPool();        //frees idle blocks
+
+    SlabPool(const SlabPool&) = delete;
+    SlabPool& operator=(const SlabPool&) = delete;
+
+    static const size_t DEFAULT_MAX_IDLE_BLOCKS;
+    static const size_t MAX_OVERSIZE;           //idle blocks more than this many times too big aren't handed out
+
+    //smallest idle block that's big enough, suitably aligned and not oversized, or a new one
+    Block acquire(const size_t bytes, const size_t alignment);
+
+    //keeps block for reuse; past max_idle_blocks, the least recently released block is freed
+    void release(const Block block);
+
+    size_t idle_blocks() const;
+
+private:
+
+    size_t m_max_idle_blocks;
+    mutable std::mutex m_mutex;
+    std::deque<Block> m_idle;       //oldest release at the front
+
+};
+
+class InstanceSlab {
+
+public:
+    InstanceSlab(std::shared_ptr<const ProgramModule> module, const size_t count);
+    InstanceSlab(std::shared_ptr<const ProgramModule> module, const size_t count, SlabPool& pool);
+    ~InstanceSlab();
+
+    InstanceSlab(const InstanceSlab&) = delete;
+    InstanceSlab& operator=(const InstanceSlab&) = delete;
+
+    static const size_t CACHE_LINE_SIZE;
+
+    size_t size() const;
+    void run(const size_t begin, const size_t end);        //runs instances [begin, end)
+
+    //bulk getters; element i is the result for instance i
+    std::vector<int> collect_registers(const int index) const;           //throws std::out_of_range
+    std::vector<int> collect_variables(const char var_name) const;       //throws std::out_of_range
+
+private:
+
+    InstanceSlab(std::shared_ptr<const ProgramModule> module, const size_t count, SlabPool* pool);
+
+    void release_block();
+    void* instance(const size_t i) const;
+
+    std::shared_ptr<const ProgramModule> m_module;
+    SlabPool* m_pool;           //nullptr if the slab owns its block
+    size_t m_count;
+    size_t m_stride;
+    SlabPool::Block m_block;
+
+};
+
+class ProgramExecutor {
+
+public:
+    explicit ProgramExecutor(const size_t num_threads = std::thread::hardware_concurrency());
+    ~ProgramExecutor();
+
+    ProgramExecutor(const ProgramExecutor&) = delete;
+    ProgramExecutor& operator=(const ProgramExecutor&) = delete;
+
+    static const size_t CHUNK_SIZE;     //instances per unit of work
+
+    size_t num_threads() const;
+
+    //runs every instance in each slab once; blocks until all have finished.
+    //if any instance throws, the rest still run and the first exception is rethrown here.
+    //a slab may appear only once; duplicates throw std::invalid_argument
+    void run(const std::vector<InstanceSlab*> slabs);
+    void run(InstanceSlab& slab);
+
+private:
+
+    struct Task {
+        InstanceSlab* slab;
+        size_t begin;
+        size_t end;
+    };
+
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void worker_loop(const size_t id);
+    bool pop_local(const size_t id, Task& task);
+    bool steal(const size_t thief, Task& task);
+
+    std::vector<std::unique_ptr<WorkQueue>> m_queues;
+    std::vector<std::thread> m_workers;
+
+    std::mutex m_run_mutex;                 //serializes concurrent callers of run()
+    std::mutex m_state_mutex;
+    std::condition_variable m_work_ready;
+    std::condition_variable m_work_done;
+    size_t m_generation;                    //bumped each time run() hands out work
+    std::atomic<size_t> m_pending;          //tasks not yet finished in the current run()
+    std::exception_ptr m_error;             //first exception thrown by a task in the current run()
+    bool m_stopping;
+
+};
+
+} //end namespace
+
+#endif
@@ -0,0 +1,113 @@
+/*
+    Loading of compiled programs into the running process.
+
+    A program generated by Compiler::compile_shared() and built with
+    "g++ -shared -fPIC" is opened with dlopen() as a ProgramModule.
+    ModuleCache keeps loaded modules by name; loading a new path under an
+    existing name swaps in the new version. Instances hold a reference to
+    their module, so a swapped-out version stays loaded until its last
+    instance is destroyed.
+
+    dlopen() returns the already-open handle for a path that's still loaded,
+    so every new version must be built to a new path.
+
+*/
+
+#ifndef PROGRAM_MODULE_HH
+#define PROGRAM_MODULE_HH
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "program_abi.hh"
+
+namespace ds_compiler {
+
+class ProgramModule {
+
+public:
+    explicit ProgramModule(const std::string so_path);
+    ~ProgramModule();
+
+    ProgramModule(const ProgramModule&) = delete;
+    ProgramModule& operator=(const ProgramModule&) = delete;
+
+    const std::string& path() const;
+
+    //thin wrappers over the exported C interface
+    void* create() const;
+    void run(void* program) const;
+    int get_register(void* program, const int index) const;       //throws std::out_of_range
+    int get_variable(void* program, const char var_name) const;   //throws std::out_of_range
+    void destroy(void* program) const;
+
+    //placement construction, used by InstanceSlab
+    std::size_t state_size() const;
+    std::size_t state_align() const;
+    void construct(void* storage) const;
+    void destruct(void* program) const;
+
+private:
+
+    void* lookup(const char* symbol) const;
+
+    std::string m_path;
+    void* m_handle;
+
+    program_abi::create_fn m_create;
+    program_abi::run_fn m_run;
+    program_abi::get_register_fn m_get_register;
+    program_abi::get_variable_fn m_get_variable;
+    program_abi::destroy_fn m_destroy;
+    program_abi::state_size_fn m_state_size;
+    program_abi::state_align_fn m_state_align;
+    program_abi::construct_fn m_construct;
+    program_abi::destruct_fn m_destruct;
+
+};
+
+//one running object of a compiled program; keeps its module loaded
+class ProgramInstance {
+
+public:
+    explicit ProgramInstance(std::shared_ptr<const ProgramModule> module);
+    ~ProgramInstance();
+
+    ProgramInstance(const ProgramInstance&) = delete;
+    ProgramInstance& operator=(const ProgramInstance&) = delete;
+
+    void run();
+    int get_register(const int index) const;
+    int get_variable(const char var_name) const;
+
+private:
+
+    std::shared_ptr<const ProgramModule> m_module;
+    void* m_program;
+
+};
+
+class ModuleCache {
+
+public:
+    ModuleCache();
+
+    //returns the cached module if name is already loaded from so_path;
+    //otherwise loads so_path and replaces whatever was cached under name
+    std::shared_ptr<const ProgramModule> load(const std::string name, const std::string so_path);
+
+    std::shared_ptr<const ProgramModule> get(const std::string name) const;    //throws std::out_of_range
+    bool contains(const std::string name) const;
+    void unload(const std::string name);
+
+private:
+
+    mutable std::mutex m_mutex;
+    std::unordered_map<std::string, std::shared_ptr<const ProgramModule>> m_modules;
+
+};
+
+} //end namespace
+
+#endif
@@ -0,0 +1,64 @@
+/*
+    Input scanner for the compiler.
+
+    Works directly on a std::string buffer instead of a stream, so peek() and
+    get() are plain index operations. Runs of whitespace, letters or digits
+    are measured 16 (SSE2) or 32 (AVX2) bytes at a time; the widest
+    implementation the CPU supports is picked at runtime, falling back to a
+    scalar loop.
+
+*/
+
+#ifndef SCANNER_HH
+#define SCANNER_HH
+
+#include <cstddef>
+#include <string>
+
+namespace ds_compiler {
+
+enum class ScanImpl { SCALAR, SSE2, AVX2 };     //ordered narrowest to widest
+
+enum class CharClass { WHITE, ALPHA, DIGIT };     //WHITE is spaces and tabs
+
+class Scanner {
+
+public:
+    //impl is clamped to best_implementation(), so asking for more than the CPU supports is safe
+    explicit Scanner(const ScanImpl impl = best_implementation());
+
+    static ScanImpl best_implementation();          //based on CPU feature detection
+    static std::string implementation_name(const ScanImpl impl);
+
+    void reset(const std::string input);
+
+    //same contract as std::istream: EOF at end of input
+    int peek() const;
+    int get();
+
+    void skip_white();
+
+    //run lengths for multi-char names/numbers; unused by Compiler while tokens
+    //stay single-char (see doc/TODO), used by spikes/scanner_benchmark.cc
+    size_t name_length() const;     //length of the run of letters at the cursor
+    size_t num_length() const;      //length of the run of digits at the cursor
+    void advance(const size_t count);
+
+    size_t position() const;
+    bool at_end() const;
+
+private:
+
+    typedef size_t (*span_fn)(const char* begin, const size_t length, const CharClass cls);
+
+    size_t span(const CharClass cls) const;
+
+    std::string m_buffer;
+    size_t m_position;
+    span_fn m_span;
+
+};
+
+} //end namespace
+
+#endif
@@ -0,0 +1,148 @@
+/*
+    Driver program; compiles each line entered into a shared object,
+    loads it into this process and runs it, swapping out the previous version.
+
+    With --check, runs one non-interactive round trip instead
+    (compile, build, load, run, reload under a new path) and exits non-zero on failure.
+
+*/
+
+#include <cstdlib>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include "compiler.hh"
+#include "program_module.hh"
+
+const std::string MODULE_DIR("build/modules/");
+const std::string CLASS_NAME("SampleClass");
+
+//builds source_file with the system compiler; returns true on success
+bool build_shared_object (const std::string source_file, const std::string so_file) {
+    std::string command("g++ -std=c++11 -Wall -Wextra -Wpedantic -pedantic-errors -shared -fPIC -o "
+                        + so_file + " " + source_file);
+    return std::system(command.c_str()) == 0;
+}
+
+//compiles one line to MODULE_DIR/<CLASS_NAME>_v<version>.so; returns the .so path
+//each version gets its own file, since dlopen() won't reload a path that's still open
+std::string compile_version (const std::string input_line, const int version) {
+    std::string base_name(MODULE_DIR + CLASS_NAME + "_v" + std::to_string(version));
+    std::string source_file(base_name + ".cc");
+    std::string so_file(base_name + ".so");
+
+    {
+        std::ofstream ofs(source_file, std::ofstream::out);
+        ds_compiler::Compiler my_compiler(ofs);
+        std::vector<std::string> program;
+        program.push_back(input_line);
+        my_compiler.compile_shared(program, CLASS_NAME);
+    }
+
+    if (!build_shared_object(source_file, so_file)) {
+        throw std::runtime_error("Building " + so_file + " failed.\n");
+    }
+    return so_file;
+}
+
+void print_registers (const ds_compiler::ProgramInstance& instance) {
+    std::cout << "Register contents\n";
+    for (size_t i = 0; i < ds_compiler::Compiler::NUM_REGISTERS; ++i) {
+        std::cout << "Register " << i << ": " << instance.get_register(i) << '\n';
+    }
+}
+
+//compile -> build -> load -> run -> get_register, then reload under a new path
+//and check the cache hands out the new version while the old instance keeps working.
+//"T" and "F" leave register 0 at 1 and 0, so each version's code is told apart by its result
+int round_trip_check () {
+    try {
+        ds_compiler::ModuleCache cache;
+
+        std::string first_so = compile_version("T", 1);
+        auto first_module = cache.load(CLASS_NAME, first_so);
+        ds_compiler::ProgramInstance first(first_module);
+        first.run();
+
+        std::string second_so = compile_version(" \tF ", 2);
+        auto second_module = cache.load(CLASS_NAME, second_so);
+        ds_compiler::ProgramInstance second(second_module);
+        second.run();
+
+        if (first_module == second_module || cache.get(CLASS_NAME) != second_module) {
+            std::cerr << "Reload didn't swap in a new module." << '\n';
+            return 1;
+        }
+        if (first.get_register(0) != 1 || second.get_register(0) != 0) {
+            std::cerr << "Instances didn't run their own version's code." << '\n';
+            return 1;
+        }
+
+        //the swapped-out module stays loaded for instances created from it, even once uncached
+        cache.unload(CLASS_NAME);
+        first_module.reset();
+        first.run();
+        if (first.get_register(0) != 1) {
+            std::cerr << "Old instance broke after its module was unloaded from the cache." << '\n';
+            return 1;
+        }
+
+        //and the old version can be loaded again
+        ds_compiler::ProgramInstance reloaded(cache.load(CLASS_NAME, first_so));
+        reloaded.run();
+        if (reloaded.get_register(0) != 1) {
+            std::cerr << "Reloading " << first_so << " didn't run version 1." << '\n';
+            return 1;
+        }
+    } catch (std::exception &ex) {
+        std::cerr << ex.what() << '\n';
+        return 1;
+    }
+
+    std::cout << "Round trip check passed." << '\n';
+    return 0;
+}
+
+int main (int argc, char *argv[]) {
+
+    if (std::system(("mkdir -p " + MODULE_DIR).c_str()) != 0) {
+        std::cerr << "Couldn't create " << MODULE_DIR << '\n';
+        return 1;
+    }
+
+    if (argc > 1 && std::string(argv[1]) == "--check") {
+        return round_trip_check();
+    }
+
+    const char QUIT_CHAR = '$';
+    const std::string PROMPT = std::string("Enter a line to be compiled and loaded ('") + QUIT_CHAR + "' to quit):\n";
+
+    ds_compiler::ModuleCache cache;
+
+    int version = 0;
+    std::string input_line = "";
+    while (std::cout << PROMPT
+            && std::getline(std::cin, input_line)) {
+
+        if (input_line.empty()) {
+            continue;
+        }
+        if (input_line.at(0) == QUIT_CHAR) {
+            break;
+        }
+
+        try {
+            std::string so_file = compile_version(input_line, ++version);
+
+            ds_compiler::ProgramInstance instance(cache.load(CLASS_NAME, so_file));
+            instance.run();
+
+            std::cout << "Loaded " << so_file << '\n';
+            print_registers(instance);
+        } catch (std::exception &ex) {
+            std::cerr << ex.what() << '\n';
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,81 @@
+/*
+    Driver program; runs many instances of a compiled program on 1..N threads
+    and reports instances/sec for each thread count.
+
+    Arguments - path to a shared object built from Compiler::compile_shared() output,
+    and optionally the number of instances (default 1000000).
+
+*/
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "program_executor.hh"
+
+int main (int argc, char *argv[]) {
+
+    //validate arguments
+    if (argc < 2) {
+        std::cerr << "Usage: parallel_runner <program.so> [instances]" << '\n';
+        return 1;
+    }
+
+    const std::string so_file(argv[1]);
+    const size_t num_instances = argc > 2 ? std::stoul(argv[2]) : 1000000;
+    const size_t ROUNDS = 5;
+    const size_t max_threads = std::max<unsigned>(std::thread::hardware_concurrency(), 1);
+
+    try {
+        ds_compiler::ModuleCache cache;
+        auto module = cache.load("program", so_file);
+
+        std::cout << "Instances: " << num_instances << ", rounds: " << ROUNDS << '\n';
+        std::cout << "threads\tinstances/sec\tspeedup" << '\n';
+
+        //powers of two, always finishing on the full core count
+        std::vector<size_t> thread_counts;
+        for (size_t threads = 1; threads < max_threads; threads *= 2) {
+            thread_counts.push_back(threads);
+        }
+        thread_counts.push_back(max_threads);
+
+        //every thread count reuses the first slab's storage
+        ds_compiler::SlabPool pool;
+
+        double single_thread_rate = 0;
+        for (auto threads : thread_counts) {
+            ds_compiler::ProgramExecutor executor(threads);
+            ds_compiler::InstanceSlab slab(module, num_instances, pool);
+
+            auto start = std::chrono::steady_clock::now();
+            for (size_t round = 0; round < ROUNDS; ++round) {
+                executor.run(slab);
+            }
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+            double rate = num_instances * ROUNDS / elapsed.count();
+            if (threads == 1) {
+                single_thread_rate = rate;
+            }
+            std::cout << threads << '\t' << static_cast<size_t>(rate) << '\t'
+                      << rate / single_thread_rate << '\n';
+        }
+
+        //sanity check that the results can be read back in bulk
+        ds_compiler::InstanceSlab slab(module, 4, pool);
+        ds_compiler::ProgramExecutor executor;
+        executor.run(slab);
+        std::cout << "Register 0 of each sample instance:";
+        for (auto value : slab.collect_registers(0)) {
+            std::cout << ' ' << value;
+        }
+        std::cout << '\n';
+    } catch (std::exception &ex) {
+        std::cerr << ex.what() << '\n';
+        return 1;
+    }
+
+    return 0;
+}
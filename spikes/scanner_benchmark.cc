@@ -0,0 +1,156 @@
+/*
+    Benchmark; tokenizes machine-generated source with very long lines,
+    comparing character-at-a-time stream scanning against each Scanner implementation.
+    Exits non-zero if any implementation disagrees with the scalar token count.
+
+    Arguments - optionally the line length in bytes (default 4000000) and number of lines (default 8).
+
+*/
+
+#include <cctype>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "scanner.hh"
+
+//runs of whitespace, names and numbers separated by single operators, like generated code
+std::string generate_line (const size_t length, std::mt19937& rng) {
+    const std::string OPERATORS("+-*/=()");
+    std::uniform_int_distribution<int> kind(0, 2);
+    std::uniform_int_distribution<size_t> run_length(1, 48);
+    std::uniform_int_distribution<int> letter(0, 25);
+    std::uniform_int_distribution<int> digit(0, 9);
+    std::uniform_int_distribution<size_t> op(0, OPERATORS.size() - 1);
+
+    std::string line;
+    line.reserve(length + 64);
+    while (line.size() < length) {
+        size_t count = run_length(rng);
+        int k = kind(rng);
+        for (size_t i = 0; i < count; ++i) {
+            if (k == 0) {
+                line += (i % 3 == 0) ? '\t' : ' ';
+            } else if (k == 1) {
+                line += static_cast<char>('a' + letter(rng));
+            } else {
+                line += static_cast<char>('0' + digit(rng));
+            }
+        }
+        line += OPERATORS.at(op(rng));
+    }
+    return line;
+}
+
+//what Compiler did before Scanner: peek()/get() on a stringstream, one byte at a time
+size_t count_tokens_stream (const std::string& line) {
+    std::stringstream ss(line);
+    size_t tokens = 0;
+    while (ss.peek() != EOF) {
+        while (ss.peek() == ' ' || ss.peek() == '\t') {
+            ss.get();
+        }
+        if (std::isalpha(ss.peek())) {
+            while (std::isalpha(ss.peek())) {
+                ss.get();
+            }
+        } else if (std::isdigit(ss.peek())) {
+            while (std::isdigit(ss.peek())) {
+                ss.get();
+            }
+        } else if (ss.get() == EOF) {
+            break;
+        }
+        ++tokens;
+    }
+    return tokens;
+}
+
+size_t count_tokens_scanner (const std::string& line, ds_compiler::Scanner& scanner) {
+    scanner.reset(line);
+    size_t tokens = 0;
+    while (!scanner.at_end()) {
+        scanner.skip_white();
+        size_t run = scanner.name_length();
+        if (run == 0) {
+            run = scanner.num_length();
+        }
+        if (run > 0) {
+            scanner.advance(run);
+        } else if (scanner.get() == EOF) {
+            break;
+        }
+        ++tokens;
+    }
+    return tokens;
+}
+
+//returns the number of tokens found
+template <typename Fn>
+size_t report (const std::string name, const std::vector<std::string>& source, Fn count_tokens) {
+    size_t bytes = 0;
+    size_t tokens = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (auto& line : source) {
+        bytes += line.size();
+        tokens += count_tokens(line);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::cout << name << '\t' << tokens << '\t'
+              << bytes / elapsed.count() / (1 << 20) << '\n';
+    return tokens;
+}
+
+int main (int argc, char *argv[]) {
+
+    const size_t line_length = argc > 1 ? std::stoul(argv[1]) : 4000000;
+    const size_t num_lines = argc > 2 ? std::stoul(argv[2]) : 8;
+
+    std::mt19937 rng(12345);
+    std::vector<std::string> source;
+    for (size_t i = 0; i < num_lines; ++i) {
+        source.push_back(generate_line(line_length, rng));
+    }
+
+    ds_compiler::ScanImpl best = ds_compiler::Scanner::best_implementation();
+    std::cout << num_lines << " lines of " << line_length << " bytes; best implementation: "
+              << ds_compiler::Scanner::implementation_name(best) << '\n';
+    std::cout << "scanner\ttokens\tMB/s" << '\n';
+
+    size_t stream_tokens = report("stream", source, count_tokens_stream);
+
+    std::vector<ds_compiler::ScanImpl> impls;
+    impls.push_back(ds_compiler::ScanImpl::SCALAR);
+    if (best != ds_compiler::ScanImpl::SCALAR) {
+        impls.push_back(ds_compiler::ScanImpl::SSE2);
+    }
+    if (best == ds_compiler::ScanImpl::AVX2) {
+        impls.push_back(ds_compiler::ScanImpl::AVX2);
+    }
+
+    //SCALAR runs first, so its count is the reference for the SIMD implementations
+    size_t scalar_tokens = 0;
+    bool all_agree = true;
+    for (auto impl : impls) {
+        ds_compiler::Scanner scanner(impl);
+        size_t tokens = report(ds_compiler::Scanner::implementation_name(impl), source,
+                               [&scanner] (const std::string& line) { return count_tokens_scanner(line, scanner); });
+        if (impl == ds_compiler::ScanImpl::SCALAR) {
+            scalar_tokens = tokens;
+        } else if (tokens != scalar_tokens) {
+            std::cerr << "Error: " << ds_compiler::Scanner::implementation_name(impl)
+                      << " found " << tokens << " tokens, scalar found " << scalar_tokens << '\n';
+            all_agree = false;
+        }
+    }
+
+    if (stream_tokens != scalar_tokens) {
+        std::cerr << "Error: stream found " << stream_tokens << " tokens, scalar found " << scalar_tokens << '\n';
+        all_agree = false;
+    }
+
+    return all_agree ? 0 : 1;
+}
@@ -8,10 +8,13 @@
 #include <stdexcept>
 #include <assert.h>
 #include "compiler.hh"
+#include "program_abi.hh"
 
 namespace ds_compiler {
     
 const size_t Compiler::NUM_REGISTERS = 8;
+const size_t Compiler::NUM_VARIABLES = 26;
+const size_t Compiler::STACK_SIZE = 16;
 const char Compiler::ERR_CHAR = '\0';
 const std::unordered_set<char> Compiler::ADD_OPS({'+', '-'});
 const std::unordered_set<char> Compiler::MULT_OPS({'*', '/'});
@@ -21,7 +24,7 @@ const std::unordered_set<char> Compiler::BOOLEAN_LITERALS({TRUE_CHAR, FALSE_CHAR
     
 //constructors
 Compiler::Compiler (std::ostream& output) 
-    : m_input_stream (std::ios::in|std::ios::out), m_output_stream(output)
+    : m_scanner(), m_output_stream(output)
 {
     
 }
@@ -30,13 +33,10 @@ Compiler::Compiler (std::ostream& output)
 
 void Compiler::compile_intermediate (const std::string input_line) {
     
-    //clear contents and error flags on m_input_stream
-    m_input_stream.str("");
-    m_input_stream.clear();
-    
-    m_input_stream << input_line;
+    m_scanner.reset(input_line);
     
     try {
+        skip_white();
         start_symbol();
     } catch (std::exception &ex) {
         std::cerr << ex.what() << '\n';
@@ -54,6 +54,15 @@ void Compiler::compile_full (const std::vector<std::string> source, const std::s
     
 }
 
+//same as compile_full(), plus extern "C" wrappers so the result can be built
+//as a shared object and loaded with ProgramModule
+void Compiler::compile_shared (const std::vector<std::string> source, const std::string class_name) {
+    
+    compile_full(source, class_name);
+    define_c_interface(class_name);
+    
+}
+
 void Compiler::compile_start (const std::string class_name) const {
     add_includes();    
    
@@ -79,48 +88,59 @@ void Compiler::compile_end () const {
 }
 
 void Compiler::add_includes() const {
-    emit_line("#include <stack>");
-    emit_line("#include <vector>");
     emit_line("#include <iostream>");
     emit_line("#include <string>");
-    emit_line("#include <unordered_map>");
+    emit_line("#include <stdexcept>");
+    emit_line("#include <cstddef>");
+    emit_line("#include <new>");
 }
 
+//all state is inline, so an object placed in an InstanceSlab doesn't touch the heap.
+//nothing in the grammar pushes yet; STACK_SIZE gets revisited (or turned into a
+//per-program depth) once expressions do
 void Compiler::define_member_variables() const {
-    emit_line("std::stack<int> cpu_stack;");
-    emit_line("std::vector<int> cpu_registers;");
-    emit_line("std::unordered_map<char, int> cpu_variables;");
+    emit_line("int cpu_stack[" + std::to_string(STACK_SIZE) + "];");
+    emit_line("int cpu_stack_depth;");
+    emit_line("int cpu_registers[" + std::to_string(NUM_REGISTERS) + "];");
+    emit_line("int cpu_variables[" + std::to_string(NUM_VARIABLES) + "];");      //indexed by name - 'A'
+    emit_line("unsigned long cpu_variables_defined;");                         //bit i set once variable i is assigned
 }
 
 void Compiler::define_constructor(const std::string class_name) const {
     emit_line(class_name + "() ");
     emit_line(": cpu_stack()");
-    emit_line(", cpu_registers(" + std::to_string(NUM_REGISTERS) + ", 0)");
+    emit_line(", cpu_stack_depth(0)");
+    emit_line(", cpu_registers()");       //value-initialized to 0
     emit_line(", cpu_variables()");
+    emit_line(", cpu_variables_defined(0)");
     emit_line("{}");
 }
 
 //emit definition of a function for easier stack handling
 void Compiler::define_cpu_pop() const {
     emit_line("int cpu_pop() {");
-    emit_line("int val = cpu_stack.top();");
-    emit_line("cpu_stack.pop();");
-    emit_line("return val; }");
+    emit_line("return cpu_stack[--cpu_stack_depth]; }");
 }
 
 void Compiler::define_getters() const {
     emit_line("int get_register(int index) {");
-    emit_line("return cpu_registers.at(index);}");
+    emit_line("if (index < 0 || index >= " + std::to_string(NUM_REGISTERS) + ")");
+    emit_line("throw std::out_of_range(\"get_register\");");
+    emit_line("return cpu_registers[index];}");
     
+    //same contract as the old unordered_map::at(): unassigned variables throw
     emit_line("int get_variable(char var_name) {");
-    emit_line("return cpu_variables.at(var_name);}");
+    emit_line("int index = var_name - 'A';");
+    emit_line("if (index < 0 || index >= " + std::to_string(NUM_VARIABLES) + " || !(cpu_variables_defined & (1UL << index)))");
+    emit_line("throw std::out_of_range(\"get_variable\");");
+    emit_line("return cpu_variables[index];}");
     
     //no getter for stack; stack should always be empty
 }
 
 void Compiler::define_is_stack_empty() const {
     emit_line("bool is_stack_empty() {");
-    emit_line("return cpu_stack.empty();}");
+    emit_line("return cpu_stack_depth == 0;}");
 }
 
 void Compiler::define_dump() const {
@@ -128,35 +148,80 @@ void Compiler::define_dump() const {
     
     emit_line("std::cout << \"Register contents\\n\";");
     emit_line("for (int i = 0; i < " + std::to_string(NUM_REGISTERS) + "; ++i)");
-    emit_line("std::cout << std::string(\"Register \") << i << \": \" << cpu_registers.at(i) << '\\n';");
+    emit_line("std::cout << std::string(\"Register \") << i << \": \" << cpu_registers[i] << '\\n';");
     
     emit_line("std::cout << \"Stack contents (top to bottom)\\n\";");
-    emit_line("while (!cpu_stack.empty()) {");
-    emit_line("std::cout << cpu_stack.top() << '\\n';");
-    emit_line("cpu_stack.pop();}");
+    emit_line("while (!is_stack_empty())");
+    emit_line("std::cout << cpu_pop() << '\\n';");
     
     emit_line("std::cout << \"Variable contents\\n\";");
-    emit_line("for (auto i = cpu_variables.begin(); i != cpu_variables.end(); ++i)"); 
-    emit_line("std::cout << \"cpu_variables[\" << i->first << \"] = \" << i->second << '\\n';");
+    emit_line("for (int i = 0; i < " + std::to_string(NUM_VARIABLES) + "; ++i)"); 
+    emit_line("if (cpu_variables_defined & (1UL << i))");
+    emit_line("std::cout << \"cpu_variables[\" << static_cast<char>('A' + i) << \"] = \" << cpu_variables[i] << '\\n';");
     
     emit_line("}");
 }
 
+//only the getter wrappers turn exceptions into status codes; create, run and
+//construct can still let std::bad_alloc out through the C interface
+void Compiler::define_c_interface(const std::string class_name) const {
+    using namespace program_abi;
+    const std::string object("static_cast<" + class_name + "*>(program)");
+    
+    emit_line("extern \"C\" {");
+    
+    emit_line("int " + std::string(ABI_VERSION_SYMBOL) + "() {");
+    emit_line("return " + std::to_string(VERSION) + ";}");
+    
+    emit_line("void* " + std::string(CREATE_SYMBOL) + "() {");
+    emit_line("return new " + class_name + "();}");
+    
+    emit_line("void " + std::string(RUN_SYMBOL) + "(void* program) {");
+    emit_line(object + "->run();}");
+    
+    emit_line("int " + std::string(GET_REGISTER_SYMBOL) + "(void* program, int index, int* value) {");
+    emit_line("try { *value = " + object + "->get_register(index); return 1; }");
+    emit_line("catch (...) { return 0; }}");
+    
+    emit_line("int " + std::string(GET_VARIABLE_SYMBOL) + "(void* program, char var_name, int* value) {");
+    emit_line("try { *value = " + object + "->get_variable(var_name); return 1; }");
+    emit_line("catch (...) { return 0; }}");
+    
+    emit_line("void " + std::string(DESTROY_SYMBOL) + "(void* program) {");
+    emit_line("delete " + object + ";}");
+    
+    //placement construction, for callers that lay out instances in their own storage
+    emit_line("std::size_t " + std::string(STATE_SIZE_SYMBOL) + "() {");
+    emit_line("return sizeof(" + class_name + ");}");
+    
+    emit_line("std::size_t " + std::string(STATE_ALIGN_SYMBOL) + "() {");
+    emit_line("return alignof(" + class_name + ");}");
+    
+    emit_line("void " + std::string(CONSTRUCT_SYMBOL) + "(void* storage) {");
+    emit_line("new (storage) " + class_name + "();}");
+    
+    emit_line("void " + std::string(DESTRUCT_SYMBOL) + "(void* program) {");
+    emit_line(object + "->~" + class_name + "();}");
+    
+    emit_line("}");     //close extern "C"
+}
+
 
 void Compiler::start_symbol () {
-    get_boolean() ? emit_line("true") : emit_line("false");
+    //result goes in register 0, as Crenshaw leaves it in D0
+    get_boolean() ? emit_line("cpu_registers[0] = true;") : emit_line("cpu_registers[0] = false;");
 }
 
 
 //boolean handling
 
 bool Compiler::get_boolean () {
-    if (!is_boolean(m_input_stream.peek())) {
+    if (!is_boolean(m_scanner.peek())) {
         expected("Boolean literal");    //will throw exception
     } 
     
-    bool boolean_value = std::toupper(m_input_stream.peek()) == TRUE_CHAR;
-    m_input_stream.get();
+    bool boolean_value = std::toupper(m_scanner.get()) == TRUE_CHAR;
+    skip_white();
     return boolean_value;
 }
 
@@ -193,31 +258,41 @@ void Compiler::expected(const char c) const {
 //checks if next character matches; if so, consume that character
 void Compiler::match(const char c) {
     
-    if (m_input_stream.peek() == c) {
-        m_input_stream.get(); 
+    if (m_scanner.peek() == c) {
+        m_scanner.get(); 
+        skip_white();
     } else {
         expected(c);
     }
 }
 
+//skips spaces and tabs; called after every token, so the parser never sees whitespace
+void Compiler::skip_white() {
+    m_scanner.skip_white();
+}
+
 // gets a valid identifier from input stream
 char Compiler::get_name () {
-    if (!std::isalpha(m_input_stream.peek())) {
+    if (!std::isalpha(m_scanner.peek())) {
         expected("Name");
         return ERR_CHAR;
     } else {
-        return std::toupper(m_input_stream.get());
+        char name = std::toupper(m_scanner.get());
+        skip_white();
+        return name;
     }
     
 }
 
 //gets a number
 char Compiler::get_num () {
-    if (!std::isdigit(m_input_stream.peek())) {
+    if (!std::isdigit(m_scanner.peek())) {
         expected("Integer");
         return ERR_CHAR;
     } else {
-        return m_input_stream.get();
+        char num = m_scanner.get();
+        skip_white();
+        return num;
     }
 }
 
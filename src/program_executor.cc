@@ -0,0 +1,324 @@
+/*
+    Implementation of InstanceSlab and ProgramExecutor.
+
+
+*/
+
+#include <algorithm>
+#include <cstdint>      //uintptr_t
+#include <limits>
+#include <new>
+#include <stdexcept>
+#include <stdlib.h>     //posix_memalign
+#include <unordered_set>
+#include "program_executor.hh"
+
+namespace ds_compiler {
+
+namespace {
+
+SlabPool::Block allocate_block (const size_t bytes, const size_t alignment) {
+    void* storage = nullptr;
+    if (posix_memalign(&storage, alignment, std::max<size_t>(bytes, 1)) != 0) {
+        throw std::bad_alloc();
+    }
+    SlabPool::Block block = { storage, bytes };
+    return block;
+}
+
+} //end anonymous namespace
+
+
+//SlabPool
+
+const size_t SlabPool::DEFAULT_MAX_IDLE_BLOCKS = 4;
+const size_t SlabPool::MAX_OVERSIZE = 2;
+
+SlabPool::SlabPool (const size_t max_idle_blocks)
+    : m_max_idle_blocks(max_idle_blocks), m_mutex(), m_idle()
+{
+
+}
+
+SlabPool::~SlabPool () {
+    for (auto& block : m_idle) {
+        free(block.storage);
+    }
+}
+
+SlabPool::Block SlabPool::acquire (const size_t bytes, const size_t alignment) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto best = m_idle.end();
+        for (auto i = m_idle.begin(); i != m_idle.end(); ++i) {
+            //a much larger block would sit mostly unused, and keep its memory from a slab that could use it
+            bool fits = i->bytes >= bytes && i->bytes / MAX_OVERSIZE <= bytes
+                        && reinterpret_cast<uintptr_t>(i->storage) % alignment == 0;
+            if (fits && (best == m_idle.end() || i->bytes < best->bytes)) {
+                best = i;
+            }
+        }
+        if (best != m_idle.end()) {
+            Block block = *best;
+            m_idle.erase(best);
+            return block;
+        }
+    }
+
+    return allocate_block(bytes, alignment);
+}
+
+void SlabPool::release (const Block block) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_idle.push_back(block);
+
+    //blocks nobody has reused for a while (e.g. outgrown by growing slabs) go first
+    while (m_idle.size() > m_max_idle_blocks) {
+        free(m_idle.front().storage);
+        m_idle.pop_front();
+    }
+}
+
+size_t SlabPool::idle_blocks () const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_idle.size();
+}
+
+
+//InstanceSlab
+
+const size_t InstanceSlab::CACHE_LINE_SIZE = 64;
+
+InstanceSlab::InstanceSlab (std::shared_ptr<const ProgramModule> module, const size_t count)
+    : InstanceSlab(module, count, nullptr)
+{
+
+}
+
+InstanceSlab::InstanceSlab (std::shared_ptr<const ProgramModule> module, const size_t count, SlabPool& pool)
+    : InstanceSlab(module, count, &pool)
+{
+
+}
+
+InstanceSlab::InstanceSlab (std::shared_ptr<const ProgramModule> module, const size_t count, SlabPool* pool)
+    : m_module(module), m_pool(pool), m_count(count), m_stride(0), m_block()
+{
+    //round each instance up to whole cache lines
+    size_t alignment = std::max(CACHE_LINE_SIZE, m_module->state_align());
+    m_stride = (m_module->state_size() + alignment - 1) / alignment * alignment;
+
+    if (m_count > std::numeric_limits<size_t>::max() / m_stride) {
+        throw std::length_error("InstanceSlab of " + std::to_string(m_count) + " instances is too large.\n");
+    }
+
+    m_block = m_pool ? m_pool->acquire(m_stride * m_count, alignment)
+                     : allocate_block(m_stride * m_count, alignment);
+
+    //the destructor won't run if this throws, so undo the instances built so far
+    size_t constructed = 0;
+    try {
+        for (; constructed < m_count; ++constructed) {
+            m_module->construct(instance(constructed));
+        }
+    } catch (...) {
+        for (size_t i = 0; i < constructed; ++i) {
+            m_module->destruct(instance(i));
+        }
+        release_block();
+        throw;
+    }
+}
+
+InstanceSlab::~InstanceSlab () {
+    for (size_t i = 0; i < m_count; ++i) {
+        m_module->destruct(instance(i));
+    }
+    release_block();
+}
+
+size_t InstanceSlab::size () const {
+    return m_count;
+}
+
+void InstanceSlab::run (const size_t begin, const size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+        m_module->run(instance(i));
+    }
+}
+
+std::vector<int> InstanceSlab::collect_registers (const int index) const {
+    std::vector<int> values;
+    values.reserve(m_count);
+    for (size_t i = 0; i < m_count; ++i) {
+        values.push_back(m_module->get_register(instance(i), index));
+    }
+    return values;
+}
+
+std::vector<int> InstanceSlab::collect_variables (const char var_name) const {
+    std::vector<int> values;
+    values.reserve(m_count);
+    for (size_t i = 0; i < m_count; ++i) {
+        values.push_back(m_module->get_variable(instance(i), var_name));
+    }
+    return values;
+}
+
+void InstanceSlab::release_block () {
+    if (m_pool) {
+        m_pool->release(m_block);
+    } else {
+        free(m_block.storage);
+    }
+}
+
+void* InstanceSlab::instance (const size_t i) const {
+    return static_cast<char*>(m_block.storage) + i * m_stride;
+}
+
+
+//ProgramExecutor
+
+const size_t ProgramExecutor::CHUNK_SIZE = 256;
+
+ProgramExecutor::ProgramExecutor (const size_t num_threads)
+    : m_queues(), m_workers(), m_run_mutex(), m_state_mutex(), m_work_ready(), m_work_done(),
+      m_generation(0), m_pending(0), m_error(), m_stopping(false)
+{
+    //hardware_concurrency() is allowed to return 0
+    size_t thread_count = std::max<size_t>(num_threads, 1);
+
+    for (size_t i = 0; i < thread_count; ++i) {
+        m_queues.push_back(std::unique_ptr<WorkQueue>(new WorkQueue()));
+    }
+    for (size_t i = 0; i < thread_count; ++i) {
+        m_workers.push_back(std::thread(&ProgramExecutor::worker_loop, this, i));
+    }
+}
+
+ProgramExecutor::~ProgramExecutor () {
+    {
+        std::lock_guard<std::mutex> lock(m_state_mutex);
+        m_stopping = true;
+    }
+    m_work_ready.notify_all();
+
+    for (auto& worker : m_workers) {
+        worker.join();
+    }
+}
+
+size_t ProgramExecutor::num_threads () const {
+    return m_workers.size();
+}
+
+void ProgramExecutor::run (const std::vector<InstanceSlab*> slabs) {
+    //the same slab twice would run the same instances on two threads at once
+    std::unordered_set<InstanceSlab*> distinct(slabs.begin(), slabs.end());
+    if (distinct.size() != slabs.size()) {
+        throw std::invalid_argument("ProgramExecutor::run() was given the same slab more than once.\n");
+    }
+
+    std::lock_guard<std::mutex> run_lock(m_run_mutex);
+
+    std::vector<Task> tasks;
+    for (auto slab : slabs) {
+        for (size_t begin = 0; begin < slab->size(); begin += CHUNK_SIZE) {
+            Task task = { slab, begin, std::min(begin + CHUNK_SIZE, slab->size()) };
+            tasks.push_back(task);
+        }
+    }
+
+    if (tasks.empty()) {
+        return;
+    }
+
+    //set before any task is visible; a worker still draining its queues may pick one up right away
+    m_pending = tasks.size();
+
+    //deal chunks out round-robin; stealing evens out whatever imbalance is left
+    for (size_t i = 0; i < tasks.size(); ++i) {
+        WorkQueue& queue = *m_queues.at(i % m_queues.size());
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(tasks.at(i));
+    }
+
+    std::unique_lock<std::mutex> lock(m_state_mutex);
+    ++m_generation;
+    m_work_ready.notify_all();
+    m_work_done.wait(lock, [this] { return m_pending == 0; });
+
+    //hand the first failure from this run back to the caller
+    if (m_error) {
+        std::exception_ptr error = m_error;
+        m_error = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+void ProgramExecutor::run (InstanceSlab& slab) {
+    run(std::vector<InstanceSlab*>(1, &slab));
+}
+
+void ProgramExecutor::worker_loop (const size_t id) {
+    size_t seen_generation = 0;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(m_state_mutex);
+            m_work_ready.wait(lock, [&] { return m_stopping || m_generation != seen_generation; });
+            if (m_stopping) {
+                return;
+            }
+            seen_generation = m_generation;
+        }
+
+        Task task;
+        while (pop_local(id, task) || steal(id, task)) {
+            //an exception escaping a worker thread would terminate the process
+            try {
+                task.slab->run(task.begin, task.end);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(m_state_mutex);
+                if (!m_error) {
+                    m_error = std::current_exception();
+                }
+            }
+
+            //last task out wakes run(); notify under the lock so the wakeup can't be missed
+            if (m_pending.fetch_sub(1) == 1) {
+                std::lock_guard<std::mutex> lock(m_state_mutex);
+                m_work_done.notify_all();
+            }
+        }
+    }
+}
+
+//owner takes from the back of its own deque...
+bool ProgramExecutor::pop_local (const size_t id, Task& task) {
+    WorkQueue& queue = *m_queues.at(id);
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty()) {
+        return false;
+    }
+    task = queue.tasks.back();
+    queue.tasks.pop_back();
+    return true;
+}
+
+//...thieves take from the front of everyone else's
+bool ProgramExecutor::steal (const size_t thief, Task& task) {
+    for (size_t offset = 1; offset < m_queues.size(); ++offset) {
+        WorkQueue& queue = *m_queues.at((thief + offset) % m_queues.size());
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty()) {
+            task = queue.tasks.front();
+            queue.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+} //end namespace
@@ -0,0 +1,175 @@
+/*
+    Implementation of ProgramModule, ProgramInstance and ModuleCache.
+
+
+*/
+
+#include <dlfcn.h>
+#include <stdexcept>
+#include "program_module.hh"
+
+namespace ds_compiler {
+
+//ProgramModule
+
+ProgramModule::ProgramModule (const std::string so_path)
+    : m_path(so_path), m_handle(dlopen(so_path.c_str(), RTLD_NOW | RTLD_LOCAL)),
+      m_create(nullptr), m_run(nullptr), m_get_register(nullptr),
+      m_get_variable(nullptr), m_destroy(nullptr), m_state_size(nullptr),
+      m_state_align(nullptr), m_construct(nullptr), m_destruct(nullptr)
+{
+    if (m_handle == nullptr) {
+        throw std::runtime_error("Couldn't load " + so_path + ": " + dlerror() + "\n");
+    }
+
+    try {
+        //casting through the function pointer typedefs; POSIX guarantees this works for dlsym()
+        auto abi_version = reinterpret_cast<program_abi::abi_version_fn>(lookup(program_abi::ABI_VERSION_SYMBOL));
+        if (abi_version() != program_abi::VERSION) {
+            throw std::runtime_error(so_path + " was built against a different program ABI version.\n");
+        }
+
+        m_create = reinterpret_cast<program_abi::create_fn>(lookup(program_abi::CREATE_SYMBOL));
+        m_run = reinterpret_cast<program_abi::run_fn>(lookup(program_abi::RUN_SYMBOL));
+        m_get_register = reinterpret_cast<program_abi::get_register_fn>(lookup(program_abi::GET_REGISTER_SYMBOL));
+        m_get_variable = reinterpret_cast<program_abi::get_variable_fn>(lookup(program_abi::GET_VARIABLE_SYMBOL));
+        m_destroy = reinterpret_cast<program_abi::destroy_fn>(lookup(program_abi::DESTROY_SYMBOL));
+        m_state_size = reinterpret_cast<program_abi::state_size_fn>(lookup(program_abi::STATE_SIZE_SYMBOL));
+        m_state_align = reinterpret_cast<program_abi::state_align_fn>(lookup(program_abi::STATE_ALIGN_SYMBOL));
+        m_construct = reinterpret_cast<program_abi::construct_fn>(lookup(program_abi::CONSTRUCT_SYMBOL));
+        m_destruct = reinterpret_cast<program_abi::destruct_fn>(lookup(program_abi::DESTRUCT_SYMBOL));
+    } catch (...) {
+        dlclose(m_handle);
+        throw;
+    }
+}
+
+ProgramModule::~ProgramModule () {
+    dlclose(m_handle);
+}
+
+const std::string& ProgramModule::path () const {
+    return m_path;
+}
+
+void* ProgramModule::create () const {
+    return m_create();
+}
+
+void ProgramModule::run (void* program) const {
+    m_run(program);
+}
+
+int ProgramModule::get_register (void* program, const int index) const {
+    int value = 0;
+    if (!m_get_register(program, index, &value)) {
+        throw std::out_of_range("No register " + std::to_string(index) + " in " + m_path + "\n");
+    }
+    return value;
+}
+
+int ProgramModule::get_variable (void* program, const char var_name) const {
+    int value = 0;
+    if (!m_get_variable(program, var_name, &value)) {
+        throw std::out_of_range("No variable " + std::string(1, var_name) + " in " + m_path + "\n");
+    }
+    return value;
+}
+
+void ProgramModule::destroy (void* program) const {
+    m_destroy(program);
+}
+
+std::size_t ProgramModule::state_size () const {
+    return m_state_size();
+}
+
+std::size_t ProgramModule::state_align () const {
+    return m_state_align();
+}
+
+void ProgramModule::construct (void* storage) const {
+    m_construct(storage);
+}
+
+void ProgramModule::destruct (void* program) const {
+    m_destruct(program);
+}
+
+void* ProgramModule::lookup (const char* symbol) const {
+    dlerror();      //clear any stale error
+    void* address = dlsym(m_handle, symbol);
+    if (address == nullptr) {
+        throw std::runtime_error(m_path + " doesn't export " + symbol + ".\n");
+    }
+    return address;
+}
+
+
+//ProgramInstance
+
+ProgramInstance::ProgramInstance (std::shared_ptr<const ProgramModule> module)
+    : m_module(module), m_program(module->create())
+{
+
+}
+
+ProgramInstance::~ProgramInstance () {
+    m_module->destroy(m_program);
+}
+
+void ProgramInstance::run () {
+    m_module->run(m_program);
+}
+
+int ProgramInstance::get_register (const int index) const {
+    return m_module->get_register(m_program, index);
+}
+
+int ProgramInstance::get_variable (const char var_name) const {
+    return m_module->get_variable(m_program, var_name);
+}
+
+
+//ModuleCache
+
+ModuleCache::ModuleCache ()
+    : m_mutex(), m_modules()
+{
+
+}
+
+std::shared_ptr<const ProgramModule> ModuleCache::load (const std::string name, const std::string so_path) {
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto cached = m_modules.find(name);
+        if (cached != m_modules.end() && cached->second->path() == so_path) {
+            return cached->second;
+        }
+    }
+
+    //dlopen() outside the lock; it can be slow, and runs the module's static initializers
+    std::shared_ptr<const ProgramModule> module = std::make_shared<const ProgramModule>(so_path);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_modules[name] = module;
+    return module;
+}
+
+std::shared_ptr<const ProgramModule> ModuleCache::get (const std::string name) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_modules.at(name);
+}
+
+bool ModuleCache::contains (const std::string name) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_modules.find(name) != m_modules.end();
+}
+
+void ModuleCache::unload (const std::string name) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_modules.erase(name);
+}
+
+} //end namespace
@@ -0,0 +1,203 @@
+/*
+    Implementation of the Scanner class.
+
+
+*/
+
+#include <algorithm>
+#include <cstdio>       //EOF
+#include "scanner.hh"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define DS_SCANNER_X86
+#include <immintrin.h>
+#endif
+
+namespace ds_compiler {
+
+namespace {
+
+//letters and digits are tested with one unsigned compare each:
+//c - 'a' wraps around for anything below 'a', so only 'a'..'z' land in [0, 25]
+bool in_class (const unsigned char c, const CharClass cls) {
+    switch (cls) {
+        case CharClass::WHITE:
+            return c == ' ' || c == '\t';
+        case CharClass::ALPHA:
+            return static_cast<unsigned char>((c | 0x20) - 'a') < 26;     //| 0x20 folds to lowercase
+        case CharClass::DIGIT:
+            return static_cast<unsigned char>(c - '0') < 10;
+    }
+    return false;
+}
+
+//each span function returns the length of the run of cls at the start of [begin, begin + length)
+
+size_t span_scalar (const char* begin, const size_t length, const CharClass cls) {
+    size_t i = 0;
+    while (i < length && in_class(begin[i], cls)) {
+        ++i;
+    }
+    return i;
+}
+
+#ifdef DS_SCANNER_X86
+
+//same tests as in_class(), on 16 bytes at once; x is in [0, limit] iff min(x, limit) == x
+__attribute__((target("sse2")))
+__m128i class_mask_sse2 (const __m128i v, const CharClass cls) {
+    switch (cls) {
+        case CharClass::WHITE:
+            return _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                                _mm_cmpeq_epi8(v, _mm_set1_epi8('\t')));
+        case CharClass::ALPHA: {
+            __m128i x = _mm_sub_epi8(_mm_or_si128(v, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+            return _mm_cmpeq_epi8(_mm_min_epu8(x, _mm_set1_epi8(25)), x);
+        }
+        case CharClass::DIGIT: {
+            __m128i x = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+            return _mm_cmpeq_epi8(_mm_min_epu8(x, _mm_set1_epi8(9)), x);
+        }
+    }
+    return _mm_setzero_si128();
+}
+
+__attribute__((target("sse2")))
+size_t span_sse2 (const char* begin, const size_t length, const CharClass cls) {
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin + i));
+        unsigned mask = _mm_movemask_epi8(class_mask_sse2(v, cls));
+        if (mask != 0xFFFF) {
+            return i + __builtin_ctz(~mask);    //first byte outside the class
+        }
+    }
+    return i + span_scalar(begin + i, length - i, cls);
+}
+
+__attribute__((target("avx2")))
+__m256i class_mask_avx2 (const __m256i v, const CharClass cls) {
+    switch (cls) {
+        case CharClass::WHITE:
+            return _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+                                   _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t')));
+        case CharClass::ALPHA: {
+            __m256i x = _mm256_sub_epi8(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+            return _mm256_cmpeq_epi8(_mm256_min_epu8(x, _mm256_set1_epi8(25)), x);
+        }
+        case CharClass::DIGIT: {
+            __m256i x = _mm256_sub_epi8(v, _mm256_set1_epi8('0'));
+            return _mm256_cmpeq_epi8(_mm256_min_epu8(x, _mm256_set1_epi8(9)), x);
+        }
+    }
+    return _mm256_setzero_si256();
+}
+
+__attribute__((target("avx2")))
+size_t span_avx2 (const char* begin, const size_t length, const CharClass cls) {
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin + i));
+        unsigned mask = _mm256_movemask_epi8(class_mask_avx2(v, cls));
+        if (mask != 0xFFFFFFFF) {
+            return i + __builtin_ctz(~mask);
+        }
+    }
+    return i + span_sse2(begin + i, length - i, cls);
+}
+
+#endif
+
+} //end anonymous namespace
+
+//constructors
+Scanner::Scanner (const ScanImpl impl)
+    : m_buffer(), m_position(0), m_span(span_scalar)
+{
+    //never install instructions the CPU lacks; they'd SIGILL on the first scan
+    ScanImpl usable = std::min(impl, best_implementation());
+
+#ifdef DS_SCANNER_X86
+    if (usable == ScanImpl::AVX2) {
+        m_span = span_avx2;
+    } else if (usable == ScanImpl::SSE2) {
+        m_span = span_sse2;
+    }
+#else
+    (void) usable;  //only the scalar implementation exists off x86
+#endif
+}
+
+ScanImpl Scanner::best_implementation () {
+#ifdef DS_SCANNER_X86
+    if (__builtin_cpu_supports("avx2")) {
+        return ScanImpl::AVX2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return ScanImpl::SSE2;
+    }
+#endif
+    return ScanImpl::SCALAR;
+}
+
+std::string Scanner::implementation_name (const ScanImpl impl) {
+    switch (impl) {
+        case ScanImpl::SCALAR:
+            return "scalar";
+        case ScanImpl::SSE2:
+            return "SSE2";
+        case ScanImpl::AVX2:
+            return "AVX2";
+    }
+    return "unknown";
+}
+
+void Scanner::reset (const std::string input) {
+    m_buffer = input;
+    m_position = 0;
+}
+
+int Scanner::peek () const {
+    if (at_end()) {
+        return EOF;
+    }
+    return static_cast<unsigned char>(m_buffer[m_position]);
+}
+
+int Scanner::get () {
+    int c = peek();
+    if (!at_end()) {
+        ++m_position;
+    }
+    return c;
+}
+
+void Scanner::skip_white () {
+    m_position += span(CharClass::WHITE);
+}
+
+size_t Scanner::name_length () const {
+    return span(CharClass::ALPHA);
+}
+
+size_t Scanner::num_length () const {
+    return span(CharClass::DIGIT);
+}
+
+void Scanner::advance (const size_t count) {
+    m_position = std::min(m_position + count, m_buffer.size());
+}
+
+size_t Scanner::position () const {
+    return m_position;
+}
+
+bool Scanner::at_end () const {
+    return m_position >= m_buffer.size();
+}
+
+size_t Scanner::span (const CharClass cls) const {
+    return m_span(m_buffer.data() + m_position, m_buffer.size() - m_position, cls);
+}
+
+} //end namespace